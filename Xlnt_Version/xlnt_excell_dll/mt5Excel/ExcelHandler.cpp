@@ -7,12 +7,18 @@
 // Include standard headers.
 #include <string>
 #include <fstream>
-#include <sstream>
 #include <vector>
 #include <ctime>
 #include <cstring>
 #include <stdexcept>
 #include <iterator> // Include iterator header for std::advance
+#include <memory>
+#include <cstddef>
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+#include <intrin.h>
+#include <crtdbg.h>
 
 // Include the xlnt library header.
 #include <xlnt/xlnt.hpp>
@@ -67,17 +73,579 @@ static void LogError(const std::string& message)
 }
 
 // ----------------------------------------------------------------------------
-// Utility function to split a string by comma into a vector of strings.
+// Instrumentation: per-export and per-phase latency histograms plus counters.
+// Define MT5EXCEL_STATS=0 to compile every timer and counter out of the DLL.
+// When compiled in, recording can still be switched off at runtime through
+// SetStatsEnabled(false), which leaves a single relaxed load per timer.
 // ----------------------------------------------------------------------------
-static std::vector<std::string> SplitString(const std::string& str)
+#ifndef MT5EXCEL_STATS
+#define MT5EXCEL_STATS 1
+#endif
+
+#if MT5EXCEL_STATS
+
+enum StatsExport
+{
+    ExportWriteToXlsx,
+    ExportReadRowCount,
+    ExportReadRow,
+    ExportCount
+};
+
+enum StatsPhase
+{
+    PhaseLoad,
+    PhaseSheetLookup,
+    PhaseSplit,
+    PhaseCellWrite,
+    PhaseCellRead,
+    PhaseSave,
+    PhaseCount
+};
+
+enum StatsCounter
+{
+    CounterBytesIn,
+    CounterBytesOut,
+    CounterRowsWritten,
+    CounterRowsRead,
+    CounterCellsWritten,
+    CounterCellsRead,
+    CounterCount
+};
+
+static const char* const kExportNames[ExportCount] = { "WriteToXlsx", "ReadRowCount", "ReadRow" };
+static const char* const kPhaseNames[PhaseCount] = { "load", "sheet_lookup", "split", "cell_write", "cell_read", "save" };
+static const char* const kCounterNames[CounterCount] = { "bytes_in", "bytes_out", "rows_written", "rows_read", "cells_written", "cells_read" };
+
+// Log-linear (HDR style) histogram of nanosecond samples. Every power of two is
+// split into 16 linear sub-buckets, so any recorded value is reported within
+// ~6% of its true value. Recording is a few relaxed atomic adds and never locks,
+// so the terminal thread and any other caller can record concurrently.
+class LatencyHistogram
+{
+public:
+    static const int SubBucketBits = 4;
+    static const int SubBucketCount = 1 << SubBucketBits;
+    static const int BucketCount = (64 - SubBucketBits + 1) * SubBucketCount;
+
+    void Record(std::uint64_t ns)
+    {
+        m_buckets[IndexOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_total.fetch_add(ns, std::memory_order_relaxed);
+
+        std::uint64_t prev = m_max.load(std::memory_order_relaxed);
+        while (ns > prev && !m_max.compare_exchange_weak(prev, ns, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    std::uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+    std::uint64_t Total() const { return m_total.load(std::memory_order_relaxed); }
+    std::uint64_t Max() const { return m_max.load(std::memory_order_relaxed); }
+
+    // Highest value equivalent to the given percentile (0-100) of the samples.
+    std::uint64_t Percentile(double percentile) const
+    {
+        std::uint64_t count = Count();
+        if (count == 0)
+            return 0;
+
+        std::uint64_t target = static_cast<std::uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(count)));
+        if (target < 1)
+            target = 1;
+
+        std::uint64_t seen = 0;
+        for (int i = 0; i < BucketCount; ++i)
+        {
+            seen += m_buckets[i].load(std::memory_order_relaxed);
+            if (seen >= target)
+            {
+                std::uint64_t upper = UpperBound(i);
+                std::uint64_t max = Max();
+                return upper < max ? upper : max;
+            }
+        }
+        return Max();
+    }
+
+    void Reset()
+    {
+        for (int i = 0; i < BucketCount; ++i)
+            m_buckets[i].store(0, std::memory_order_relaxed);
+        m_count.store(0, std::memory_order_relaxed);
+        m_total.store(0, std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static int MostSignificantBit(std::uint64_t value)
+    {
+        unsigned long index = 0;
+#if defined(_WIN64)
+        _BitScanReverse64(&index, value);
+        return static_cast<int>(index);
+#else
+        unsigned long high = static_cast<unsigned long>(value >> 32);
+        if (high != 0)
+        {
+            _BitScanReverse(&index, high);
+            return static_cast<int>(index) + 32;
+        }
+        _BitScanReverse(&index, static_cast<unsigned long>(value));
+        return static_cast<int>(index);
+#endif
+    }
+
+    static int IndexOf(std::uint64_t value)
+    {
+        if (value < SubBucketCount)
+            return static_cast<int>(value);
+
+        int shift = MostSignificantBit(value) - SubBucketBits;
+        return (shift + 1) * SubBucketCount + static_cast<int>((value >> shift) & (SubBucketCount - 1));
+    }
+
+    static std::uint64_t UpperBound(int index)
+    {
+        if (index < SubBucketCount)
+            return static_cast<std::uint64_t>(index);
+
+        int shift = index / SubBucketCount - 1;
+        std::uint64_t subBucket = static_cast<std::uint64_t>(SubBucketCount + index % SubBucketCount);
+        return (subBucket << shift) + ((std::uint64_t(1) << shift) - 1);
+    }
+
+    // Zero-initialised because every histogram has static storage duration.
+    std::atomic<std::uint64_t> m_buckets[BucketCount];
+    std::atomic<std::uint64_t> m_count;
+    std::atomic<std::uint64_t> m_total;
+    std::atomic<std::uint64_t> m_max;
+};
+
+static std::atomic<bool> g_statsEnabled(true);
+static LatencyHistogram g_exportLatency[ExportCount];
+static LatencyHistogram g_phaseLatency[ExportCount][PhaseCount];
+static std::atomic<std::uint64_t> g_exportErrors[ExportCount];
+static std::atomic<std::uint64_t> g_counters[CounterCount];
+
+static bool StatsEnabled()
 {
-    std::vector<std::string> tokens;
-    std::istringstream stream(str);
-    std::string token;
-    while (std::getline(stream, token, ','))
+    return g_statsEnabled.load(std::memory_order_relaxed);
+}
+
+static std::uint64_t TicksToNanoseconds(std::uint64_t ticks)
+{
+    static const std::uint64_t frequency = []()
     {
-        tokens.push_back(token);
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return static_cast<std::uint64_t>(f.QuadPart);
+    }();
+
+    // Split the conversion to avoid overflowing ticks * 1e9.
+    return (ticks / frequency) * 1000000000ULL + (ticks % frequency) * 1000000000ULL / frequency;
+}
+
+static std::uint64_t ReadTicks()
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return static_cast<std::uint64_t>(now.QuadPart);
+}
+
+// Records the elapsed time into a histogram when stopped or destroyed, so an
+// export timer still records calls that leave through an exception.
+class StatsTimer
+{
+public:
+    explicit StatsTimer(LatencyHistogram& histogram)
+        : m_histogram(histogram), m_start(0), m_running(StatsEnabled())
+    {
+        if (m_running)
+            m_start = ReadTicks();
     }
+
+    ~StatsTimer()
+    {
+        Stop();
+    }
+
+    void Stop()
+    {
+        if (!m_running)
+            return;
+        m_running = false;
+        m_histogram.Record(TicksToNanoseconds(ReadTicks() - m_start));
+    }
+
+private:
+    StatsTimer(const StatsTimer&) = delete;
+    StatsTimer& operator=(const StatsTimer&) = delete;
+
+    LatencyHistogram& m_histogram;
+    std::uint64_t m_start;
+    bool m_running;
+};
+
+// Records the elapsed time only when explicitly stopped. A phase abandoned by
+// an early return or an exception leaves no sample, so failed opens, missing
+// sheets and throwing loads/saves do not skew the phase percentiles.
+class PhaseTimer
+{
+public:
+    explicit PhaseTimer(LatencyHistogram& histogram)
+        : m_histogram(histogram), m_start(0), m_running(StatsEnabled())
+    {
+        if (m_running)
+            m_start = ReadTicks();
+    }
+
+    void Stop()
+    {
+        if (!m_running)
+            return;
+        m_running = false;
+        m_histogram.Record(TicksToNanoseconds(ReadTicks() - m_start));
+    }
+
+private:
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    LatencyHistogram& m_histogram;
+    std::uint64_t m_start;
+    bool m_running;
+};
+
+static void StatsAdd(StatsCounter counter, std::uint64_t amount)
+{
+    if (StatsEnabled())
+        g_counters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+static void StatsError(StatsExport exportId)
+{
+    if (StatsEnabled())
+        g_exportErrors[exportId].fetch_add(1, std::memory_order_relaxed);
+}
+
+// ----------------------------------------------------------------------------
+// Heap allocation counting. The debug CRT lets us hook every malloc/realloc
+// made through it, which covers this DLL and a debug xlnt linked against the
+// same CRT. Release CRTs have no such hook, so the counts are only available
+// in _DEBUG builds; GetStats reports "heap_tracking":false otherwise.
+// ----------------------------------------------------------------------------
+#if defined(_DEBUG)
+#define MT5EXCEL_HEAP_STATS 1
+#else
+#define MT5EXCEL_HEAP_STATS 0
+#endif
+
+#if MT5EXCEL_HEAP_STATS
+
+static std::atomic<std::uint64_t> g_exportHeapAllocations[ExportCount];
+static std::atomic<std::uint64_t> g_exportHeapAllocationsMax[ExportCount];
+
+// Per-thread running count; the hook must not allocate, so it only bumps this.
+static thread_local std::uint64_t t_heapAllocations = 0;
+
+static _CRT_ALLOC_HOOK g_previousAllocHook = nullptr;
+
+static int __cdecl CountingAllocHook(int allocType, void* userData, size_t size, int blockType,
+                                     long requestNumber, const unsigned char* filename, int lineNumber)
+{
+    if ((allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC) && blockType != _CRT_BLOCK)
+        ++t_heapAllocations;
+
+    if (g_previousAllocHook)
+        return g_previousAllocHook(allocType, userData, size, blockType, requestNumber, filename, lineNumber);
+    return TRUE;
+}
+
+// Installs the hook when the DLL is loaded and restores the previous one on
+// unload, so the CRT never calls into an unmapped module.
+class AllocHookInstaller
+{
+public:
+    AllocHookInstaller()
+    {
+        g_previousAllocHook = _CrtSetAllocHook(CountingAllocHook);
+    }
+
+    ~AllocHookInstaller()
+    {
+        _CrtSetAllocHook(g_previousAllocHook);
+    }
+};
+
+static AllocHookInstaller g_allocHookInstaller;
+
+// Adds the heap allocations the calling thread made during an export call to
+// that export's totals when destroyed.
+class HeapAllocationScope
+{
+public:
+    explicit HeapAllocationScope(StatsExport exportId)
+        : m_exportId(exportId), m_start(t_heapAllocations), m_enabled(StatsEnabled())
+    {
+    }
+
+    ~HeapAllocationScope()
+    {
+        if (!m_enabled)
+            return;
+
+        std::uint64_t allocations = t_heapAllocations - m_start;
+        g_exportHeapAllocations[m_exportId].fetch_add(allocations, std::memory_order_relaxed);
+
+        std::uint64_t prev = g_exportHeapAllocationsMax[m_exportId].load(std::memory_order_relaxed);
+        while (allocations > prev &&
+               !g_exportHeapAllocationsMax[m_exportId].compare_exchange_weak(prev, allocations, std::memory_order_relaxed))
+        {
+        }
+    }
+
+private:
+    HeapAllocationScope(const HeapAllocationScope&) = delete;
+    HeapAllocationScope& operator=(const HeapAllocationScope&) = delete;
+
+    StatsExport m_exportId;
+    std::uint64_t m_start;
+    bool m_enabled;
+};
+
+#define STATS_HEAP_SCOPE(name, exportId) HeapAllocationScope name(exportId)
+
+#else
+
+#define STATS_HEAP_SCOPE(name, exportId) ((void)0)
+
+#endif // MT5EXCEL_HEAP_STATS
+
+static void AppendHistogramJson(std::string& json, const char* name, const LatencyHistogram& histogram)
+{
+    json += "\"";
+    json += name;
+    json += "\":{\"count\":" + std::to_string(histogram.Count());
+    json += ",\"total_ns\":" + std::to_string(histogram.Total());
+    json += ",\"max_ns\":" + std::to_string(histogram.Max());
+    json += ",\"p50_ns\":" + std::to_string(histogram.Percentile(50.0));
+    json += ",\"p99_ns\":" + std::to_string(histogram.Percentile(99.0));
+    json += ",\"p999_ns\":" + std::to_string(histogram.Percentile(99.9));
+}
+
+static std::string BuildStatsJson()
+{
+    std::string json = "{\"compiled\":true,\"enabled\":";
+    json += StatsEnabled() ? "true" : "false";
+    json += ",\"heap_tracking\":";
+    json += MT5EXCEL_HEAP_STATS ? "true" : "false";
+
+    json += ",\"exports\":{";
+    for (int i = 0; i < ExportCount; ++i)
+    {
+        if (i > 0)
+            json += ",";
+        AppendHistogramJson(json, kExportNames[i], g_exportLatency[i]);
+        json += ",\"errors\":" + std::to_string(g_exportErrors[i].load(std::memory_order_relaxed));
+#if MT5EXCEL_HEAP_STATS
+        json += ",\"heap_allocations\":" + std::to_string(g_exportHeapAllocations[i].load(std::memory_order_relaxed));
+        json += ",\"heap_allocations_max\":" + std::to_string(g_exportHeapAllocationsMax[i].load(std::memory_order_relaxed));
+#endif
+
+        json += ",\"phases\":{";
+        for (int j = 0; j < PhaseCount; ++j)
+        {
+            if (j > 0)
+                json += ",";
+            AppendHistogramJson(json, kPhaseNames[j], g_phaseLatency[i][j]);
+            json += "}";
+        }
+        json += "}}";
+    }
+
+    json += "},\"counters\":{";
+    for (int i = 0; i < CounterCount; ++i)
+    {
+        if (i > 0)
+            json += ",";
+        json += "\"";
+        json += kCounterNames[i];
+        json += "\":" + std::to_string(g_counters[i].load(std::memory_order_relaxed));
+    }
+    json += "}}";
+    return json;
+}
+
+#define STATS_EXPORT_TIMER(name, exportId) StatsTimer name(g_exportLatency[exportId])
+#define STATS_PHASE_TIMER(name, exportId, phase) PhaseTimer name(g_phaseLatency[exportId][phase])
+#define STATS_STOP(name) name.Stop()
+#define STATS_ADD(counter, amount) StatsAdd(counter, static_cast<std::uint64_t>(amount))
+#define STATS_ERROR(exportId) StatsError(exportId)
+
+#else
+
+static std::string BuildStatsJson()
+{
+    return "{\"compiled\":false,\"enabled\":false,\"heap_tracking\":false}";
+}
+
+#define STATS_EXPORT_TIMER(name, exportId) ((void)0)
+#define STATS_PHASE_TIMER(name, exportId, phase) ((void)0)
+#define STATS_HEAP_SCOPE(name, exportId) ((void)0)
+#define STATS_STOP(name) ((void)0)
+#define STATS_ADD(counter, amount) ((void)0)
+#define STATS_ERROR(exportId) ((void)0)
+
+#endif // MT5EXCEL_STATS
+
+// ----------------------------------------------------------------------------
+// Per-call arena: a thread-local bump allocator for the transient data that
+// WriteToXlsx owns itself (the copy of the data string and its token table).
+// The export opens a CallArenaScope, which resets the arena on the way out.
+// A request that does not fit the block is served from the heap, and the next
+// call grows the block so the same payload fits, up to MaxRetainedCapacity.
+// Filenames, sheet titles and everything xlnt does still use the heap.
+// ----------------------------------------------------------------------------
+class CallArena
+{
+public:
+    static const std::size_t InitialCapacity = 64 * 1024;
+    static const std::size_t MaxRetainedCapacity = 1024 * 1024;
+
+    CallArena()
+        : m_capacity(0), m_wantedCapacity(InitialCapacity), m_used(0), m_overflowBytes(0)
+    {
+    }
+
+    // May throw std::bad_alloc; only call it inside an export's try block.
+    void* Allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t))
+    {
+        if (!m_block || m_capacity != m_wantedCapacity)
+        {
+            // Release the old block first so both are never held at once.
+            m_block.reset();
+            m_capacity = 0;
+            m_block.reset(new char[m_wantedCapacity]);
+            m_capacity = m_wantedCapacity;
+        }
+
+        std::size_t offset = (m_used + alignment - 1) & ~(alignment - 1);
+        if (offset + size <= m_capacity)
+        {
+            m_used = offset + size;
+            return m_block.get() + offset;
+        }
+
+        // Does not fit: serve this request from the heap. Later requests that
+        // still fit keep bumping the block.
+        std::unique_ptr<char[]> chunk(new char[size + alignment]);
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(chunk.get());
+        m_overflow.push_back(std::move(chunk));
+        m_overflowBytes += size + alignment;
+        return reinterpret_cast<void*>((address + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1));
+    }
+
+    template <typename T>
+    T* AllocateArray(std::size_t count)
+    {
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Copies length bytes of str and appends a terminator.
+    char* CopyString(const char* str, std::size_t length)
+    {
+        char* copy = AllocateArray<char>(length + 1);
+        std::memcpy(copy, str, length);
+        copy[length] = '\0';
+        return copy;
+    }
+
+    // Runs from a destructor, so it must not allocate or throw. Growing or
+    // shrinking the block is deferred to the next Allocate.
+    void Reset()
+    {
+        if (m_overflowBytes > 0)
+        {
+            // Size the block so the next call of the same shape fits in one
+            // piece, unless that would keep more than MaxRetainedCapacity alive.
+            std::size_t needed = m_used + m_overflowBytes;
+            std::size_t capacity = m_capacity * 2;
+            while (capacity < needed && capacity <= MaxRetainedCapacity)
+                capacity *= 2;
+
+            m_wantedCapacity = capacity <= MaxRetainedCapacity ? capacity : InitialCapacity;
+            m_overflow.clear();
+        }
+
+        m_used = 0;
+        m_overflowBytes = 0;
+    }
+
+private:
+    CallArena(const CallArena&) = delete;
+    CallArena& operator=(const CallArena&) = delete;
+
+    std::unique_ptr<char[]> m_block;
+    std::size_t m_capacity;
+    std::size_t m_wantedCapacity;
+    std::size_t m_used;
+    std::vector<std::unique_ptr<char[]>> m_overflow;
+    std::size_t m_overflowBytes;
+};
+
+static thread_local CallArena t_callArena;
+
+class CallArenaScope
+{
+public:
+    CallArenaScope() = default;
+    ~CallArenaScope()
+    {
+        t_callArena.Reset();
+    }
+
+private:
+    CallArenaScope(const CallArenaScope&) = delete;
+    CallArenaScope& operator=(const CallArenaScope&) = delete;
+};
+
+// ----------------------------------------------------------------------------
+// Utility function to split a string by comma. The string is copied into the
+// call arena and tokenised in place; the returned token table also lives in
+// the arena. Matches the std::getline splitting used previously: a trailing
+// empty field is dropped, so "a,b," yields two tokens and "" yields none.
+// ----------------------------------------------------------------------------
+static const char** SplitString(const char* str, std::size_t length, std::size_t& tokenCount)
+{
+    char* buffer = t_callArena.CopyString(str, length);
+
+    std::size_t fields = 1;
+    for (std::size_t i = 0; i < length; ++i)
+    {
+        if (buffer[i] == ',')
+            ++fields;
+    }
+
+    const char** tokens = t_callArena.AllocateArray<const char*>(fields);
+    std::size_t count = 0;
+    char* fieldStart = buffer;
+    for (std::size_t i = 0; i < length; ++i)
+    {
+        if (buffer[i] == ',')
+        {
+            buffer[i] = '\0';
+            tokens[count++] = fieldStart;
+            fieldStart = buffer + i + 1;
+        }
+    }
+
+    if (*fieldStart != '\0')
+        tokens[count++] = fieldStart;
+
+    tokenCount = count;
     return tokens;
 }
 
@@ -86,18 +654,27 @@ static std::vector<std::string> SplitString(const std::string& str)
 // ----------------------------------------------------------------------------
 extern "C" __declspec(dllexport) bool __stdcall WriteToXlsx(const char* filename, const char* sheetName, const char* data)
 {
+    STATS_EXPORT_TIMER(callTimer, ExportWriteToXlsx);
+    STATS_HEAP_SCOPE(heapScope, ExportWriteToXlsx);
+    CallArenaScope arenaScope;
     try
     {
         if (!filename || !sheetName || !data)
             throw std::invalid_argument("Null pointer passed as parameter.");
 
+        // xlnt only accepts paths and titles as std::string.
         std::string fileStr(filename);
         std::string sheetStr(sheetName);
-        std::string dataStr(data);
 
         // Split the data string by commas.
-        std::vector<std::string> dataArray = SplitString(dataStr);
+        STATS_PHASE_TIMER(splitTimer, ExportWriteToXlsx, PhaseSplit);
+        std::size_t dataLength = std::strlen(data);
+        std::size_t tokenCount = 0;
+        const char** tokens = SplitString(data, dataLength, tokenCount);
+        STATS_STOP(splitTimer);
+        STATS_ADD(CounterBytesIn, dataLength);
 
+        STATS_PHASE_TIMER(loadTimer, ExportWriteToXlsx, PhaseLoad);
         xlnt::workbook wb;
         std::ifstream infile(fileStr);
         if (infile.good())
@@ -105,21 +682,13 @@ extern "C" __declspec(dllexport) bool __stdcall WriteToXlsx(const char* filename
             wb.load(fileStr);
         }
         infile.close();
+        STATS_STOP(loadTimer);
 
+        STATS_PHASE_TIMER(lookupTimer, ExportWriteToXlsx, PhaseSheetLookup);
         xlnt::worksheet ws;
-        bool sheetExists = false;
 
         // Check if the sheet exists
-        for (const auto& title : wb.sheet_titles())
-        {
-            if (title == sheetStr)
-            {
-                sheetExists = true;
-                break;
-            }
-        }
-
-        if (sheetExists)
+        if (wb.contains(sheetStr))
         {
             ws = wb.sheet_by_title(sheetStr);
         }
@@ -128,8 +697,10 @@ extern "C" __declspec(dllexport) bool __stdcall WriteToXlsx(const char* filename
             ws = wb.create_sheet();
             ws.title(sheetStr);
         }
+        STATS_STOP(lookupTimer);
 
         // Determine the next row to write to.
+        STATS_PHASE_TIMER(writeTimer, ExportWriteToXlsx, PhaseCellWrite);
         auto startRow = ws.highest_row();
         if (ws.cell("A1").value<std::string>().empty() && startRow == 1)
         {
@@ -141,30 +712,37 @@ extern "C" __declspec(dllexport) bool __stdcall WriteToXlsx(const char* filename
         }
 
         // Write each data element into successive columns (starting at column 1).
-       // for (std::size_t i = 0; i < dataArray.size(); ++i)
+       // for (std::size_t i = 0; i < tokenCount; ++i)
         //{
-         //   ws.cell(startRow, static_cast<std::uint32_t>(i + 1)).value(dataArray[i]);
+         //   ws.cell(startRow, static_cast<std::uint32_t>(i + 1)).value(tokens[i]);
         //}
 
         // Instead of writing across columns, write down rows
-        for (std::size_t i = 0; i < dataArray.size(); ++i)
+        for (std::size_t i = 0; i < tokenCount; ++i)
         {
-            ws.cell(static_cast<std::uint32_t>(1 + i), startRow).value(dataArray[i]); // Always column 1, increase row
+            ws.cell(static_cast<std::uint32_t>(1 + i), startRow).value(tokens[i]); // Always column 1, increase row
         }
+        STATS_STOP(writeTimer);
+        STATS_ADD(CounterRowsWritten, 1);
+        STATS_ADD(CounterCellsWritten, tokenCount);
 
 
 
         // Save the workbook.
+        STATS_PHASE_TIMER(saveTimer, ExportWriteToXlsx, PhaseSave);
         wb.save(fileStr);
+        STATS_STOP(saveTimer);
         return true;
     }
     catch (const std::exception& ex)
     {
+        STATS_ERROR(ExportWriteToXlsx);
         LogError(std::string("An error occurred in WriteToXlsx: ") + ex.what());
         return false;
     }
     catch (...)
     {
+        STATS_ERROR(ExportWriteToXlsx);
         LogError("An unknown error occurred in WriteToXlsx.");
         return false;
     }
@@ -175,48 +753,50 @@ extern "C" __declspec(dllexport) bool __stdcall WriteToXlsx(const char* filename
 // ----------------------------------------------------------------------------
 extern "C" __declspec(dllexport) int __stdcall ReadRowCount(const char* filename, const char* sheetName)
 {
+    STATS_EXPORT_TIMER(callTimer, ExportReadRowCount);
+    STATS_HEAP_SCOPE(heapScope, ExportReadRowCount);
     try
     {
         if (!filename || !sheetName)
             throw std::invalid_argument("Null pointer passed as parameter.");
 
+        // xlnt only accepts paths and titles as std::string.
         std::string fileStr(filename);
         std::string sheetStr(sheetName);
 
+        STATS_PHASE_TIMER(loadTimer, ExportReadRowCount, PhaseLoad);
         xlnt::workbook wb;
         std::ifstream infile(fileStr);
         if (!infile.good())
         {
+            STATS_ERROR(ExportReadRowCount);
             LogError("File does not exist in ReadRowCount.");
             return 0;
         }
         wb.load(fileStr);
         infile.close();
+        STATS_STOP(loadTimer);
 
+        STATS_PHASE_TIMER(lookupTimer, ExportReadRowCount, PhaseSheetLookup);
         xlnt::worksheet ws;
-        bool sheetExists = false;
 
         // Check if the sheet exists
-        for (const auto& title : wb.sheet_titles())
-        {
-            if (title == sheetStr)
-            {
-                sheetExists = true;
-                break;
-            }
-        }
-
-        if (!sheetExists)
+        if (!wb.contains(sheetStr))
         {
+            STATS_ERROR(ExportReadRowCount);
             LogError("Sheet '" + sheetStr + "' does not exist in the file in ReadRowCount.");
             return 0;
         }
 
         ws = wb.sheet_by_title(sheetStr);
+        STATS_STOP(lookupTimer);
 
         // Return the highest row with data.
+        STATS_PHASE_TIMER(readTimer, ExportReadRowCount, PhaseCellRead);
         auto highestRow = ws.highest_row();
-        if (ws.cell("A1").value<std::string>().empty() && highestRow == 1)
+        bool sheetEmpty = ws.cell("A1").value<std::string>().empty() && highestRow == 1;
+        STATS_STOP(readTimer);
+        if (sheetEmpty)
         {
             return 0;
         }
@@ -227,11 +807,13 @@ extern "C" __declspec(dllexport) int __stdcall ReadRowCount(const char* filename
     }
     catch (const std::exception& ex)
     {
+        STATS_ERROR(ExportReadRowCount);
         LogError(std::string("An error occurred in ReadRowCount: ") + ex.what());
         return 0;
     }
     catch (...)
     {
+        STATS_ERROR(ExportReadRowCount);
         LogError("An unknown error occurred in ReadRowCount.");
         return 0;
     }
@@ -242,21 +824,28 @@ extern "C" __declspec(dllexport) int __stdcall ReadRowCount(const char* filename
 // ----------------------------------------------------------------------------
 extern "C" __declspec(dllexport) void __stdcall ReadRow(const char* filename, const char* sheetName, int rowNumber, char* result, int resultSize)
 {
+    STATS_EXPORT_TIMER(callTimer, ExportReadRow);
+    STATS_HEAP_SCOPE(heapScope, ExportReadRow);
     try
     {
         // Check for null pointers
         if (!filename || !sheetName || !result)
             throw std::invalid_argument("Null pointer passed as parameter.");
 
+        // xlnt only accepts paths and titles as std::string.
         std::string fileStr(filename);
         std::string sheetStr(sheetName);
 
+        STATS_PHASE_TIMER(loadTimer, ExportReadRow, PhaseLoad);
         xlnt::workbook wb;
         // Load the workbook
         wb.load(fileStr);
+        STATS_STOP(loadTimer);
 
+        STATS_PHASE_TIMER(lookupTimer, ExportReadRow, PhaseSheetLookup);
         if (!wb.contains(sheetStr))
         {
+            STATS_ERROR(ExportReadRow);
             LogError("Sheet '" + sheetStr + "' does not exist in the file.");
             if (result && resultSize > 0)
                 result[0] = '\0'; // Ensure result is empty
@@ -264,10 +853,12 @@ extern "C" __declspec(dllexport) void __stdcall ReadRow(const char* filename, co
         }
 
         xlnt::worksheet ws = wb.sheet_by_title(sheetStr);
+        STATS_STOP(lookupTimer);
 
         // Verify that the requested row exists
         if (rowNumber < 1 || rowNumber > static_cast<int>(ws.highest_row()))
         {
+            STATS_ERROR(ExportReadRow);
             LogError("Row " + std::to_string(rowNumber) + " does not exist in the sheet.");
             if (result && resultSize > 0)
                 result[0] = '\0'; // Ensure result is empty
@@ -275,6 +866,7 @@ extern "C" __declspec(dllexport) void __stdcall ReadRow(const char* filename, co
         }
 
         // Find the last column with data in the specified row
+        STATS_PHASE_TIMER(readTimer, ExportReadRow, PhaseCellRead);
         unsigned int lastColumnWithData = 0;
         unsigned int highestColumnIndex = ws.highest_column().index;
 
@@ -289,55 +881,152 @@ extern "C" __declspec(dllexport) void __stdcall ReadRow(const char* filename, co
 
         if (lastColumnWithData == 0)
         {
+            STATS_STOP(readTimer);
             // The row has no data
             if (result && resultSize > 0)
                 result[0] = '\0'; // Ensure result is empty
             return;
         }
 
-        // Build the CSV string up to the last column with data
-        std::ostringstream oss;
+        // Format the CSV row up to the last column with data straight into the result buffer
+        std::size_t capacity = resultSize > 0 ? static_cast<std::size_t>(resultSize) - 1 : 0;
+        std::size_t length = 0;
+        bool fits = true;
         for (unsigned int col = 1; col <= lastColumnWithData; ++col)
         {
             if (col > 1)
-                oss << ",";
+            {
+                if (length + 1 > capacity)
+                {
+                    fits = false;
+                    break;
+                }
+                result[length++] = ',';
+            }
 
+            // Empty cells between data are left as empty fields
             xlnt::cell cell = ws.cell(xlnt::cell_reference(col, rowNumber));
             if (cell.has_value())
             {
-                oss << cell.to_string();
-            }
-            else
-            {
-                // Include empty strings for empty cells between data
-                oss << "";
+                const std::string text = cell.to_string();
+                if (length + text.size() > capacity)
+                {
+                    fits = false;
+                    break;
+                }
+                std::memcpy(result + length, text.data(), text.size());
+                length += text.size();
             }
         }
-
-        std::string rowData = oss.str();
+        STATS_STOP(readTimer);
 
         // Check if the result buffer is large enough
-        if (static_cast<int>(rowData.size() + 1) > resultSize)
+        if (!fits || resultSize <= 0)
         {
+            STATS_ERROR(ExportReadRow);
             LogError("Result buffer size is too small in ReadRow.");
             if (result && resultSize > 0)
                 result[0] = '\0'; // Ensure result is empty
             return;
         }
 
-        // Copy the CSV string into the result buffer
-        std::memcpy(result, rowData.c_str(), rowData.size() + 1);
+        result[length] = '\0';
+        STATS_ADD(CounterRowsRead, 1);
+        STATS_ADD(CounterCellsRead, lastColumnWithData);
+        STATS_ADD(CounterBytesOut, length);
     }
     catch (const std::exception& ex)
     {
+        STATS_ERROR(ExportReadRow);
         LogError("An error occurred in ReadRow: " + std::string(ex.what()));
         if (result && resultSize > 0)
             result[0] = '\0'; // Ensure result is empty
     }
     catch (...)
     {
+        STATS_ERROR(ExportReadRow);
         LogError("An unknown error occurred in ReadRow.");
         if (result && resultSize > 0)
             result[0] = '\0'; // Ensure result is empty
     }
 }
+
+// ----------------------------------------------------------------------------
+// Exported Function: GetStats
+// Writes the latency histograms and counters as a JSON object into buffer.
+// ----------------------------------------------------------------------------
+extern "C" __declspec(dllexport) bool __stdcall GetStats(char* buffer, int bufferSize)
+{
+    try
+    {
+        if (!buffer)
+            throw std::invalid_argument("Null pointer passed as parameter.");
+
+        std::string json = BuildStatsJson();
+
+        // Check if the buffer is large enough
+        if (static_cast<int>(json.size() + 1) > bufferSize)
+        {
+            LogError("Result buffer size is too small in GetStats.");
+            if (bufferSize > 0)
+                buffer[0] = '\0'; // Ensure result is empty
+            return false;
+        }
+
+        std::memcpy(buffer, json.c_str(), json.size() + 1);
+        return true;
+    }
+    catch (const std::exception& ex)
+    {
+        LogError("An error occurred in GetStats: " + std::string(ex.what()));
+        if (buffer && bufferSize > 0)
+            buffer[0] = '\0'; // Ensure result is empty
+        return false;
+    }
+    catch (...)
+    {
+        LogError("An unknown error occurred in GetStats.");
+        if (buffer && bufferSize > 0)
+            buffer[0] = '\0'; // Ensure result is empty
+        return false;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Exported Function: SetStatsEnabled
+// Switches recording on or off at runtime. No effect when MT5EXCEL_STATS is 0.
+// ----------------------------------------------------------------------------
+extern "C" __declspec(dllexport) void __stdcall SetStatsEnabled(bool enabled)
+{
+#if MT5EXCEL_STATS
+    g_statsEnabled.store(enabled, std::memory_order_relaxed);
+#else
+    (void)enabled;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// Exported Function: ResetStats
+// Clears all histograms and counters.
+// ----------------------------------------------------------------------------
+extern "C" __declspec(dllexport) void __stdcall ResetStats()
+{
+#if MT5EXCEL_STATS
+    for (int i = 0; i < ExportCount; ++i)
+    {
+        g_exportLatency[i].Reset();
+        g_exportErrors[i].store(0, std::memory_order_relaxed);
+#if MT5EXCEL_HEAP_STATS
+        g_exportHeapAllocations[i].store(0, std::memory_order_relaxed);
+        g_exportHeapAllocationsMax[i].store(0, std::memory_order_relaxed);
+#endif
+    }
+    for (int i = 0; i < ExportCount; ++i)
+    {
+        for (int j = 0; j < PhaseCount; ++j)
+            g_phaseLatency[i][j].Reset();
+    }
+    for (int i = 0; i < CounterCount; ++i)
+        g_counters[i].store(0, std::memory_order_relaxed);
+#endif
+}